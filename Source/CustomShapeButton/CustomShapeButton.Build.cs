@@ -23,6 +23,7 @@ public class CustomShapeButton : ModuleRules
 				"CoreUObject", "Engine", "Slate", "SlateCore" // Core
 				, "RHI" // FRHITexture2D
 				, "RenderCore" // Render threads
+				, "InputCore" // EKeys for cursor events in manager ticks
 			}
 		);
 	}
@@ -27,10 +27,22 @@ void UCustomShapeButton::ForceUpdateImage()
 {
 	if (const TSharedPtr<SCustomShapeButton> CustomShapeButton = GetSlateCustomShapeButton())
 	{
+		CustomShapeButton->SetAlphaSettings(AlphaThreshold, bInvertAlpha);
 		CustomShapeButton->ForceUpdateImage();
 	}
 }
 
+// Applies all properties to the underlying slate button
+void UCustomShapeButton::SynchronizeProperties()
+{
+	Super::SynchronizeProperties();
+
+	if (const TSharedPtr<SCustomShapeButton> CustomShapeButton = GetSlateCustomShapeButton())
+	{
+		CustomShapeButton->SetAlphaSettings(AlphaThreshold, bInvertAlpha);
+	}
+}
+
 // Is called when the underlying SWidget needs to be constructed
 TSharedRef<SWidget> UCustomShapeButton::RebuildWidget()
 {
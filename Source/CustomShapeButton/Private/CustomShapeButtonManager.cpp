@@ -1,15 +1,23 @@
-// Copyright (c) Yevhenii Selivanov
+﻿// Copyright (c) Yevhenii Selivanov
 
 #include "CustomShapeButtonManager.h"
 //---
 #include "CustomShapeButton.h"
 #include "SCustomShapeButton.h"
 //---
+#include "InputCoreTypes.h"
 #include "Engine/Engine.h"
+#include "Framework/Application/SlateApplication.h"
+#include "HAL/IConsoleManager.h"
 #include "Input/Reply.h"
 //---
 #include UE_INLINE_GENERATED_CPP_BY_NAME(CustomShapeButtonManager)
 
+static TAutoConsoleVariable<int32> CVarMaskUpdatesPerFrame(
+	TEXT("CustomShapeButton.MaskUpdatesPerFrame"),
+	4,
+	TEXT("How many button masks can be requested for readback per frame, the closest to the cursor or focus are loaded first."));
+
 // Returns the manager instance, or crash if can't be obtained
 UCustomShapeButtonManager& UCustomShapeButtonManager::Get()
 {
@@ -51,6 +59,8 @@ void UCustomShapeButtonManager::RegisterButton(UCustomShapeButton* Button)
 	{
 		RegisteredButtons.Add(Button);
 	}
+
+	MarkHitTestableButtonsDirty();
 }
 
 // Unregisters a button when it is destroyed
@@ -63,7 +73,10 @@ void UCustomShapeButtonManager::UnregisterButton(UCustomShapeButton* Button)
 		return;
 	}
 
-	RegisteredButtons.RemoveAtSwap(Index);
+	// Keep the descending order of OverlapOrder, the hit-testable buttons rely on it
+	RegisteredButtons.RemoveAt(Index);
+
+	MarkHitTestableButtonsDirty();
 }
 
 // Returns true is button is initialized and ready to handle events
@@ -84,13 +97,13 @@ bool UCustomShapeButtonManager::CanRegisterButton(const UCustomShapeButton* Butt
 // Handles any mouse event using a delegate
 FReply UCustomShapeButtonManager::HandleEvent(const FPointerEvent& Event, const TFunctionRef<FReply(const TSharedRef<SCustomShapeButton>&)>& Callback)
 {
+	UpdateHitTestableButtons(Event);
+
 	FReply FinalReply = FReply::Unhandled();
 
-	for (const TSoftObjectPtr<UCustomShapeButton>& It : RegisteredButtons)
+	for (const TWeakPtr<SCustomShapeButton>& It : HitTestableButtons)
 	{
-		const UCustomShapeButton* Button = It.Get();
-		SCustomShapeButton* SButton = Button ? Button->GetSlateCustomShapeButton().Get() : nullptr;
-		if (SButton)
+		if (const TSharedPtr<SCustomShapeButton> SButton = It.Pin())
 		{
 			SButton->HandleEvent(/*out*/FinalReply, Event, Callback);
 		}
@@ -99,6 +112,100 @@ FReply UCustomShapeButtonManager::HandleEvent(const FPointerEvent& Event, const
 	return FinalReply;
 }
 
+// Rebuilds the list of hit-testable buttons once per frame
+void UCustomShapeButtonManager::UpdateHitTestableButtons(const FPointerEvent& Event)
+{
+	const int64 CurrentFrame = static_cast<int64>(GFrameCounter);
+	if (HitTestableButtonsFrame == CurrentFrame)
+	{
+		// Is already up to date for this frame
+		return;
+	}
+
+	HitTestableButtonsFrame = CurrentFrame;
+	HitTestableButtons.Reset();
+
+	// RegisteredButtons are sorted by overlap order, so the filtered list keeps the same order
+	for (const TSoftObjectPtr<UCustomShapeButton>& It : RegisteredButtons)
+	{
+		const UCustomShapeButton* Button = It.Get();
+		const TSharedPtr<SCustomShapeButton> SButton = Button ? Button->GetSlateCustomShapeButton() : nullptr;
+		if (!SButton)
+		{
+			continue;
+		}
+
+		if (SButton->IsHitTestable())
+		{
+			HitTestableButtons.Emplace(SButton);
+		}
+		else
+		{
+			// Button is not interactive anymore, so it should not remain hovered
+			SButton->Unhover(Event);
+		}
+	}
+}
+
+// Enqueues hit-testable buttons without mask and loads the masks of the closest ones within the frame budget
+void UCustomShapeButtonManager::UpdatePendingMasks(const FVector2D& CursorPosition)
+{
+	// Enqueue buttons as soon as they become visible, so masks are ready before the cursor arrives
+	for (const TWeakPtr<SCustomShapeButton>& It : HitTestableButtons)
+	{
+		const TSharedPtr<SCustomShapeButton> SButton = It.Pin();
+		if (SButton && SButton->TryQueueRawColorsUpdate())
+		{
+			PendingMaskButtons.Emplace(SButton);
+		}
+	}
+
+	PendingMaskButtons.RemoveAllSwap([](const TWeakPtr<SCustomShapeButton>& It)
+	{
+		const TSharedPtr<SCustomShapeButton> SButton = It.Pin();
+		return !SButton || SButton->GetMaskState() != ECustomShapeMaskState::Queued;
+	});
+
+	const int32 MaxUpdates = CVarMaskUpdatesPerFrame.GetValueOnGameThread();
+	if (PendingMaskButtons.IsEmpty()
+		|| MaxUpdates <= 0)
+	{
+		return;
+	}
+
+	// Buttons next to the focused widget are likely to be reached by focus navigation
+	const TSharedPtr<SWidget> FocusedWidget = FSlateApplication::Get().GetUserFocusedWidget(0);
+	const TOptional<FVector2D> FocusPosition = FocusedWidget
+		? FocusedWidget->GetCachedGeometry().GetAbsolutePositionAtCoordinates(FVector2D(0.5f))
+		: TOptional<FVector2D>();
+
+	// Prioritize by the squared distance to the cursor or to the focused widget, whichever is closer
+	TArray<TPair<double, TSharedPtr<SCustomShapeButton>>> PrioritizedButtons;
+	PrioritizedButtons.Reserve(PendingMaskButtons.Num());
+	for (const TWeakPtr<SCustomShapeButton>& It : PendingMaskButtons)
+	{
+		TSharedPtr<SCustomShapeButton> SButton = It.Pin();
+		const FVector2D Center = SButton->GetCachedGeometry().GetAbsolutePositionAtCoordinates(FVector2D(0.5f));
+		const double CursorDistSquared = FVector2D::DistSquared(Center, CursorPosition);
+		const double Priority = FocusPosition ? FMath::Min(CursorDistSquared, FVector2D::DistSquared(Center, *FocusPosition)) : CursorDistSquared;
+		PrioritizedButtons.Emplace(Priority, MoveTemp(SButton));
+	}
+
+	// Load the closest masks first, the rest will wait for next frames
+	PrioritizedButtons.Sort([](const TPair<double, TSharedPtr<SCustomShapeButton>>& A, const TPair<double, TSharedPtr<SCustomShapeButton>>& B)
+	{
+		return A.Key < B.Key;
+	});
+
+	const int32 NumUpdates = FMath::Min(MaxUpdates, PrioritizedButtons.Num());
+	for (int32 Index = 0; Index < NumUpdates; ++Index)
+	{
+		PrioritizedButtons[Index].Value->TryUpdateRawColorsOnce();
+	}
+
+	// Updated buttons are not queued anymore, so they will be removed from the pending list on next frame
+}
+
 /*********************************************************************************************
  * Overrides
  ********************************************************************************************* */
@@ -109,10 +216,45 @@ void UCustomShapeButtonManager::Initialize(FSubsystemCollectionBase& Collection)
 	Super::Initialize(Collection);
 
 	FWorldDelegates::OnWorldCleanup.AddUObject(this, &ThisClass::OnEndPlay);
+
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::Tick));
+}
+
+// Called when this subsystem is deinitialized to perform cleanup
+void UCustomShapeButtonManager::Deinitialize()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+	TickerHandle.Reset();
+
+	Super::Deinitialize();
+}
+
+// Is called every frame to keep hit-testable buttons up to date and to load pending masks
+bool UCustomShapeButtonManager::Tick(float DeltaTime)
+{
+	if (RegisteredButtons.IsEmpty()
+		|| !FSlateApplication::IsInitialized())
+	{
+		// Nothing to update
+		return true;
+	}
+
+	// Refresh hit-testable buttons even if no events are received, the cursor might be outside of any button
+	const FSlateApplication& SlateApplication = FSlateApplication::Get();
+	const FVector2D CursorPosition = SlateApplication.GetCursorPos();
+	const FPointerEvent CursorEvent(CursorPosition, SlateApplication.GetLastCursorPos(), SlateApplication.GetPressedMouseButtons(), EKeys::Invalid, 0.f, SlateApplication.GetModifierKeys());
+	UpdateHitTestableButtons(CursorEvent);
+
+	UpdatePendingMasks(CursorPosition);
+
+	return true;
 }
 
 // Is called on the game world end play to cleanup data
 void UCustomShapeButtonManager::OnEndPlay(UWorld* World, bool bArg, bool bCond)
 {
 	RegisteredButtons.Empty();
+	HitTestableButtons.Empty();
+	PendingMaskButtons.Empty();
+	MarkHitTestableButtonsDirty();
 }
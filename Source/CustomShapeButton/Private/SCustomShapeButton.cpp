@@ -10,6 +10,7 @@
 #include "RHICommandList.h"
 #include "RHIResources.h"
 #include "TextureResource.h"
+#include "Async/Async.h"
 #include "Engine/Engine.h"
 #include "Engine/Texture2D.h"
 #include "Engine/World.h"
@@ -48,7 +49,8 @@ void SCustomShapeButton::SetTextureSize(const FIntPoint& InSize)
 // Forces to update the Raw Colors (pixels data) about current image
 void SCustomShapeButton::ForceUpdateImage()
 {
-	RawColors.Empty();
+	HitMask.Empty();
+	MaskState = ECustomShapeMaskState::None;
 	TryUpdateRawColorsOnce();
 }
 
@@ -82,6 +84,87 @@ uint32 SCustomShapeButton::GetCurrentPointIndex() const
 	return PixelRow + LocalPositionX;
 }
 
+// Returns true if the button can be hit by the pointer at all
+bool SCustomShapeButton::IsHitTestable() const
+{
+	// Paint might be skipped for a frame by Slate, so allow a small gap
+	constexpr uint64 MaxPaintFramesAge = 2;
+
+	// Under invalidation root the paint is cached and not repeated every frame, so its age can't be used there
+	// In such case only the ancestors check below is applied: scrolled-out or clipped buttons are not culled
+	const bool bIsCachedByInvalidation = GetProxyHandle().IsValid(this);
+	if (!bIsCachedByInvalidation
+		&& (LastPaintFrame == 0 || GFrameCounter - LastPaintFrame > MaxPaintFramesAge))
+	{
+		// Button was not painted recently: it is collapsed, scrolled out or its parent is not shown
+		return false;
+	}
+
+	if (!bLastPaintEnabled)
+	{
+		// Button or any of its parents was disabled during last paint
+		return false;
+	}
+
+	if (!GetVisibility().IsHitTestVisible()
+		|| !IsEnabled())
+	{
+		// Button itself is hidden, disabled or is not hit-testable
+		return false;
+	}
+
+	for (const SWidget* Parent = GetParentWidget().Get(); Parent; Parent = Parent->GetParentWidget().Get())
+	{
+		if (!Parent->GetVisibility().AreChildrenHitTestVisible()
+			|| !Parent->IsEnabled())
+		{
+			// Any of ancestors is hidden, disabled or does not let its children to be hit-tested
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Unhovers the button if it is hovered
+void SCustomShapeButton::Unhover(const FPointerEvent& Event)
+{
+	if (IsHovered())
+	{
+		OnMouseLeave_Unhovered(Event);
+	}
+}
+
+// Sets given pixels data as the button's mask directly
+void SCustomShapeButton::SetRawColors(TArray<FColor>&& InRawColors, const FIntPoint& InSize)
+{
+	if (!ensureMsgf(InRawColors.Num() == InSize.X * InSize.Y, TEXT("ASSERT: [%i] %hs:\n'InRawColors' does not match the given size!"), __LINE__, __FUNCTION__))
+	{
+		return;
+	}
+
+	SetTextureSize(InSize);
+	OnRawColorsUpdated(MoveTemp(InRawColors), MakeHitMaskParams(/*bIsMaterial*/false));
+}
+
+// Sets how pixels alpha is converted into the hit mask
+void SCustomShapeButton::SetAlphaSettings(int32 InAlphaThreshold, bool bInInvertAlpha)
+{
+	AlphaThreshold = FMath::Clamp(InAlphaThreshold, INDEX_NONE, MAX_uint8 - 1);
+	bInvertAlpha = bInInvertAlpha;
+}
+
+int32 SCustomShapeButton::OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const
+{
+	// Remember paint-time state to know if the button is still on the screen and where it is clipped
+	LastPaintFrame = GFrameCounter;
+	// Culling rect is in window space, while pointer events are in desktop space
+	LastCullingRect = MyCullingRect.OffsetBy(Args.GetWindowToDesktopTransform());
+	bLastPaintEnabled = ShouldBeEnabled(bParentEnabled);
+
+	return SButton::OnPaint(Args, AllottedGeometry, MyCullingRect, OutDrawElements, LayerId, InWidgetStyle, bParentEnabled);
+}
+
 FReply SCustomShapeButton::OnMouseButtonDown(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent)
 {
 	return HANDLE_EVENT(SButton::OnMouseButtonDown(MyGeometry, MouseEvent));
@@ -143,9 +226,9 @@ FReply SCustomShapeButton::OnMouseEnter_Hovered(const FGeometry& MyGeometry, con
 // Returns true if cursor is hovered on a texture
 bool SCustomShapeButton::IsAlphaPixelHovered() const
 {
-	if (RawColors.IsEmpty())
+	if (HitMask.Num() == 0)
 	{
-		// Raw Colors are not set
+		// Hit mask is not built yet
 		return false;
 	}
 
@@ -163,34 +246,34 @@ bool SCustomShapeButton::IsAlphaPixelHovered() const
 		return false;
 	}
 
-	const uint32 BufferPosition = GetCurrentPointIndex();
-	if (!RawColors.IsValidIndex(BufferPosition))
+	if (!LastCullingRect.ContainsPoint(CachedPointerEvent.GetScreenSpacePosition()))
 	{
+		// Pointer is on the clipped part of the button, e.g. partially scrolled out
 		return false;
 	}
 
-	const uint8 HoveredPixel = RawColors[BufferPosition].A;
-	const uint8 HoveredPixelNormalized = HoveredPixel > 0 ? 1 : 0;
-
-	constexpr uint8 TextureAlpha = 1;
-	constexpr uint8 MaterialAlpha = 0;
-
-	return HoveredPixelNormalized == (RenderTarget ? MaterialAlpha : TextureAlpha);
+	// Threshold, inversion and image type are already baked into the mask, so it's a single bit lookup
+	const int32 BufferPosition = static_cast<int32>(GetCurrentPointIndex());
+	return HitMask.IsValidIndex(BufferPosition) && HitMask[BufferPosition];
 }
 
-// Set once on render thread the buffer data about all pixels of current image if was not set before
+// Set once the buffer data about all pixels of current image if was not set before
 void SCustomShapeButton::TryUpdateRawColorsOnce()
 {
-	if (!RawColors.IsEmpty())
+	if (MaskState == ECustomShapeMaskState::Loading
+		|| MaskState == ECustomShapeMaskState::Loaded)
 	{
-		// Buffer data is already cached, use ForceUpdateImage to refresh it
+		// Buffer data is already cached or is being loaded, use ForceUpdateImage to refresh it
 		return;
 	}
 
+	MaskState = ECustomShapeMaskState::Loading;
+
 	const FSlateBrush* ImageBrush = GetBorderImage();
 	UObject* InImage = ImageBrush ? ImageBrush->GetResourceObject() : nullptr;
 	if (!ensureMsgf(InImage, TEXT("%hs: 'InImage' is null, most likely no texture is set in the Button Style"), __FUNCTION__))
 	{
+		RetryRawColorsUpdateLater();
 		return;
 	}
 
@@ -205,7 +288,32 @@ void SCustomShapeButton::TryUpdateRawColorsOnce()
 	else
 	{
 		ensureMsgf(false, TEXT("ASSERT: [%i] %hs:\nNo image is set!"), __LINE__, __FUNCTION__);
+		RetryRawColorsUpdateLater();
+	}
+}
+
+// Marks the mask to be loaded by the manager's queue
+bool SCustomShapeButton::TryQueueRawColorsUpdate()
+{
+	if (MaskState != ECustomShapeMaskState::None
+		|| GFrameCounter < MaskRetryFrame)
+	{
+		// Is already queued, loading or loaded, or waits to retry failed readback
+		return false;
 	}
+
+	MaskState = ECustomShapeMaskState::Queued;
+	return true;
+}
+
+// Resets the mask state after failed readback, so the manager queues it again after a short delay
+void SCustomShapeButton::RetryRawColorsUpdateLater()
+{
+	// Texture resource might be not created yet, so don't retry every frame
+	constexpr uint64 RetryDelayFrames = 30;
+
+	MaskState = ECustomShapeMaskState::None;
+	MaskRetryFrame = GFrameCounter + RetryDelayFrames;
 }
 
 // Copies the buffer data from the texture
@@ -213,28 +321,7 @@ void SCustomShapeButton::UpdateRawColors_Texture(const UTexture2D& Texture)
 {
 	SetTextureSize(FIntPoint(Texture.GetSizeX(), Texture.GetSizeY()));
 
-	// Get Raw Colors data on Render thread
-	TWeakPtr<SCustomShapeButton> WeakThisPtr = StaticCastWeakPtr<SCustomShapeButton>(AsWeak());
-	checkf(WeakThisPtr.IsValid(), TEXT("ERROR: [%i] %hs:\n'WeakThis' is not valid!"), __LINE__, __FUNCTION__);
-	const TWeakObjectPtr<const UTexture2D> WeakTexture = &Texture;
-	const FIntRect TextureSize(0, 0, TextureRes.X, TextureRes.Y);
-	ENQUEUE_RENDER_COMMAND(TryUpdateRawColorsOnce)([WeakThisPtr, WeakTexture, TextureSize](FRHICommandListImmediate& RHICmdList)
-	{
-		SCustomShapeButton* This = WeakThisPtr.Pin().Get();
-		if (!ensureMsgf(This, TEXT("ASSERT: [%i] %hs:\n'This' is not valid!"), __LINE__, __FUNCTION__))
-		{
-			return;
-		}
-
-		const UTexture2D* Texture2D = WeakTexture.Get();
-		const FTextureResource* TextureResource = Texture2D ? Texture2D->GetResource() : nullptr;
-		FRHITexture* RHITexture = TextureResource ? TextureResource->GetTexture2DRHI() : nullptr;
-		if (ensureMsgf(RHITexture, TEXT("%hs: 'RHITexture' is not valid"), __FUNCTION__))
-		{
-			// Copy data to cache
-			RHICmdList.ReadSurfaceData(RHITexture, TextureSize, /*out*/This->RawColors, FReadSurfaceDataFlags());
-		}
-	});
+	ReadRawColorsAsync(Texture, /*bIsMaterial*/false);
 }
 
 // Copies the buffer data from the material
@@ -256,11 +343,82 @@ void SCustomShapeButton::UpdateRawColors_Material(UMaterialInterface& Material)
 	// Clear created Render Target now before rendering material
 	UKismetRenderingLibrary::ClearRenderTarget2D(GWorld, RenderTarget.Get());
 
-	// Render our material first before copying pixels data
+	// Render our material first before copying pixels data, both are only enqueued to render thread and don't block
 	UKismetRenderingLibrary::DrawMaterialToRenderTarget(GWorld, RenderTarget.Get(), &Material);
 
 	// Copy pixels data from Render Target to our cache
-	UKismetRenderingLibrary::ReadRenderTarget(GWorld, RenderTarget.Get(), /*out*/RawColors);
+	ReadRawColorsAsync(*RenderTarget, /*bIsMaterial*/true);
+}
+
+// Reads the buffer data of given texture on render thread and applies it on game thread
+void SCustomShapeButton::ReadRawColorsAsync(const UTexture& Texture, bool bIsMaterial)
+{
+	TWeakPtr<SCustomShapeButton> WeakThisPtr = StaticCastWeakPtr<SCustomShapeButton>(AsWeak());
+	checkf(WeakThisPtr.IsValid(), TEXT("ERROR: [%i] %hs:\n'WeakThis' is not valid!"), __LINE__, __FUNCTION__);
+	const TWeakObjectPtr<const UTexture> WeakTexture = &Texture;
+	const FIntRect TextureSize(0, 0, TextureRes.X, TextureRes.Y);
+	const FCustomShapeHitMaskParams Params = MakeHitMaskParams(bIsMaterial);
+	ENQUEUE_RENDER_COMMAND(TryUpdateRawColorsOnce)([WeakThisPtr, WeakTexture, TextureSize, Params](FRHICommandListImmediate& RHICmdList)
+	{
+		TArray<FColor> NewRawColors;
+
+		const UTexture* InTexture = WeakTexture.Get();
+		const FTextureResource* TextureResource = InTexture ? InTexture->GetResource() : nullptr;
+		FRHITexture* RHITexture = TextureResource ? TextureResource->GetTexture2DRHI() : nullptr;
+		if (ensureMsgf(RHITexture, TEXT("%hs: 'RHITexture' is not valid"), __FUNCTION__))
+		{
+			RHICmdList.ReadSurfaceData(RHITexture, TextureSize, /*out*/NewRawColors, FReadSurfaceDataFlags());
+		}
+
+		// Apply data on game thread, so the hover path never waits and never races with the render thread
+		AsyncTask(ENamedThreads::GameThread, [WeakThisPtr, Params, NewRawColors = MoveTemp(NewRawColors)]() mutable
+		{
+			if (const TSharedPtr<SCustomShapeButton> This = WeakThisPtr.Pin())
+			{
+				This->OnRawColorsUpdated(MoveTemp(NewRawColors), Params);
+			}
+		});
+	});
+}
+
+// Returns the hit mask params from current alpha settings for given image type
+FCustomShapeHitMaskParams SCustomShapeButton::MakeHitMaskParams(bool bIsMaterial) const
+{
+	// By default, materials are hit-testable only on fully opaque pixels and textures on any non-transparent one
+	const int32 DefaultThreshold = bIsMaterial ? MAX_uint8 - 1 : 0;
+
+	FCustomShapeHitMaskParams Params;
+	Params.AlphaThreshold = AlphaThreshold != INDEX_NONE ? AlphaThreshold : DefaultThreshold;
+	Params.bInvertAlpha = bInvertAlpha;
+	Params.bIsMaterial = bIsMaterial;
+	return Params;
+}
+
+// Is called on game thread when the buffer data is read back
+void SCustomShapeButton::OnRawColorsUpdated(TArray<FColor>&& InRawColors, const FCustomShapeHitMaskParams& Params)
+{
+	if (InRawColors.IsEmpty()
+		|| InRawColors.Num() != TextureRes.X * TextureRes.Y)
+	{
+		// Readback failed, e.g. texture resource was not created yet
+		RetryRawColorsUpdateLater();
+		return;
+	}
+
+	// Material is drawn to the render target with inverted alpha, so flip it to get the opacity
+	const uint8 AlphaMask = Params.bIsMaterial ? MAX_uint8 : 0;
+
+	HitMask.Init(false, InRawColors.Num());
+	for (int32 Index = 0; Index < InRawColors.Num(); ++Index)
+	{
+		const uint8 Alpha = InRawColors[Index].A ^ AlphaMask;
+		if ((Alpha > Params.AlphaThreshold) != Params.bInvertAlpha)
+		{
+			HitMask[Index] = true;
+		}
+	}
+
+	MaskState = ECustomShapeMaskState::Loaded;
 }
 
 // Attempts to process the event and returns a reply
@@ -269,16 +427,14 @@ void SCustomShapeButton::HandleEvent(FReply& OutReply, const FPointerEvent& Even
 	// Skip if button was already handled during previous iteration, unhover all underlay buttons
 	if (OutReply.IsEventHandled())
 	{
-		if (IsHovered())
-		{
-			OnMouseLeave_Unhovered(Event);
-		}
-
+		Unhover(Event);
 		return;
 	}
 
 	CachedPointerEvent = Event;
-	TryUpdateRawColorsOnce();
+
+	// Mask is queued and loaded asynchronously only by the manager, prioritized by distance to the pointer
+	// Until it is ready, the button is not hovered instead of blocking on readback
 
 	const bool bIsHoveredNow = IsAlphaPixelHovered();
 	if (IsHovered() == bIsHoveredNow)
@@ -1,4 +1,4 @@
-// Copyright (c) Yevhenii Selivanov.
+﻿// Copyright (c) Yevhenii Selivanov.
 
 #pragma once
 
@@ -35,12 +35,26 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Custom Shape Button")
 	void ForceUpdateImage();
 
+	/** Applies all properties to the underlying slate button, e.g. when they are changed in the designer. */
+	virtual void SynchronizeProperties() override;
+
 	/** Defines the button's Z-order priority for event handling.
 	 * Higher values mean the button is visually and interactively above others.
 	 * Used during registration to ensure correct overlap behavior. */
 	UPROPERTY(EditAnywhere, Category = "CustomShape")
 	int32 OverlapOrder = 0;
 
+	/** Pixels with alpha above this value are treated as the button's shape for hover and press.
+	 * Increase it to ignore faint antialiased edges around the image.
+	 * -1 is the default per image type: any non-transparent pixel for textures, only fully opaque pixels for materials.
+	 * Is applied once when the image is cached, call ForceUpdateImage to apply changes in runtime. */
+	UPROPERTY(EditAnywhere, Category = "CustomShape", meta = (ClampMin = "-1", ClampMax = "254"))
+	int32 AlphaThreshold = INDEX_NONE;
+
+	/** If true, the shape is inverted: pixels with alpha at or below the Alpha Threshold are hoverable instead. */
+	UPROPERTY(EditAnywhere, Category = "CustomShape")
+	bool bInvertAlpha = false;
+
 protected:
 	/** Is called when the underlying SWidget needs to be constructed. */
 	virtual TSharedRef<SWidget> RebuildWidget() override;
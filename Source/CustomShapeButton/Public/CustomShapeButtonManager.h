@@ -1,9 +1,11 @@
-// Copyright (c) Yevhenii Selivanov
+﻿// Copyright (c) Yevhenii Selivanov
 
 #pragma once
 
 #include "Subsystems/EngineSubsystem.h"
 //---
+#include "Containers/Ticker.h"
+//---
 #include "CustomShapeButtonManager.generated.h"
 
 class SCustomShapeButton;
@@ -46,6 +48,23 @@ public:
 	 * @return Returns FReply::Handled() if the event was handled, otherwise FReply::Unhandled(). */
 	FReply HandleEvent(const struct FPointerEvent& Event, const TFunctionRef<FReply(const TSharedRef<SCustomShapeButton>&)>& Callback);
 
+	/** Marks the hit-testable buttons to be rebuilt on next event, e.g. when registered buttons or their visibility is changed. */
+	void MarkHitTestableButtonsDirty() { HitTestableButtonsFrame = INDEX_NONE; }
+
+	/** Is called every frame to keep hit-testable buttons up to date and to load pending masks.
+	 * Is public to let benchmarks measure the per-frame cost. */
+	bool Tick(float DeltaTime);
+
+protected:
+	/** Rebuilds the list of hit-testable buttons once per frame, unhovers buttons that stopped being hit-testable.
+	 * @param Event The pointer event that is currently handled, is used to unhover dropped buttons. */
+	void UpdateHitTestableButtons(const struct FPointerEvent& Event);
+
+	/** Enqueues hit-testable buttons without mask and loads the masks of the closest ones within the frame budget.
+	 * The closer the button to the cursor or to the focused widget, the sooner its mask is loaded.
+	 * @param CursorPosition The current cursor position in screen space. */
+	void UpdatePendingMasks(const FVector2D& CursorPosition);
+
 	/*********************************************************************************************
 	 * Data
 	 ********************************************************************************************* */
@@ -55,6 +74,19 @@ protected:
 	UPROPERTY(VisibleInstanceOnly, BlueprintReadWrite, Transient, AdvancedDisplay, meta = (BlueprintProtected, DisplayName = "All Hidden Widgets"))
 	TArray<TSoftObjectPtr<UCustomShapeButton>> RegisteredButtons;
 
+	/** Subset of registered buttons that can be hit by the pointer at all, in the same overlap order.
+	 * Buttons that are not painted, hidden or disabled are excluded to not be iterated on each event. */
+	TArray<TWeakPtr<SCustomShapeButton>> HitTestableButtons;
+
+	/** The frame number when the hit-testable buttons were rebuilt last time. */
+	int64 HitTestableButtonsFrame = INDEX_NONE;
+
+	/** Buttons that are waiting for their mask to be loaded in the background. */
+	TArray<TWeakPtr<SCustomShapeButton>> PendingMaskButtons;
+
+	/** Handle of the ticker that loads pending masks every frame. */
+	FTSTicker::FDelegateHandle TickerHandle;
+
 	/*********************************************************************************************
 	 * Overrides
 	 ********************************************************************************************* */
@@ -62,6 +94,9 @@ protected:
 	/** Called when this subsystem is initialized to perform initial setup. */
 	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
 
+	/** Called when this subsystem is deinitialized to perform cleanup. */
+	virtual void Deinitialize() override;
+
 	/** Is called on the game world end play to cleanup data. */
 	void OnEndPlay(UWorld* World, bool bArg, bool bCond);
 };
@@ -7,6 +7,37 @@
 #include "UObject/StrongObjectPtr.h"
 #include "Engine/TextureRenderTarget2D.h"
 
+/**
+ * Defines the loading state of the button's mask (Raw Colors).
+ */
+enum class ECustomShapeMaskState : uint8
+{
+	/** Mask is not requested yet, or the last readback failed and will be retried. */
+	None,
+	/** Mask is waiting in the manager's queue to be loaded. */
+	Queued,
+	/** Mask is being read back from the texture or material. */
+	Loading,
+	/** Mask loading is finished and the hit mask is built. */
+	Loaded
+};
+
+/**
+ * Defines how the read back pixels alpha is converted into the hit mask.
+ * Is captured when the readback starts, so a late result is not built with settings of another image.
+ */
+struct FCustomShapeHitMaskParams
+{
+	/** Pixels with alpha above this value are hit-testable, the default of the image type is already resolved. */
+	int32 AlphaThreshold = 0;
+
+	/** If true, pixels with alpha at or below the threshold are hit-testable instead. */
+	bool bInvertAlpha = false;
+
+	/** Is true if pixels are read from the material render target, where alpha is inverted. */
+	bool bIsMaterial = false;
+};
+
 /**
  * Implements slate button with one difference:
  * it proceed events (hover, press) if only the mouse is on the button's non-alpha pixel.
@@ -34,13 +65,57 @@ public:
 	 * By default, image is cached only once at the beginning. */
 	void ForceUpdateImage();
 
+	/** Set once the buffer data about all pixels of current image if was not set before.
+	 * Is asynchronous: the data is read back on render thread and applied on game thread later, so it never blocks.
+	 * Is called by the manager for queued buttons, there is no need to call it manually: the manager loads masks of all visible buttons. */
+	virtual void TryUpdateRawColorsOnce();
+
+	/** Returns current loading state of the mask. */
+	ECustomShapeMaskState GetMaskState() const { return MaskState; }
+
 	/** Calculates the index of the pixel under the cursor.
 	 * Returns -1 if the cursor is not on the button or can't access the data. */
 	uint32 GetCurrentPointIndex() const;
 
+	/** Returns true if the button can be hit by the pointer at all: it was painted recently, is enabled and hit-test visible,
+	 * and none of its ancestors is hidden, disabled or blocks hit-testing of its children.
+	 * Buttons inside collapsed parents, closed widget switchers or scrolled-out panels are not painted, so they are not hit-testable.
+	 * Under invalidation roots the paint is cached, so scrolled-out or clipped buttons there are not detected. */
+	virtual bool IsHitTestable() const;
+
+	/** Unhovers the button if it is hovered, e.g. when it is covered by another button or stops being hit-testable. */
+	void Unhover(const FPointerEvent& Event);
+
+	/** Sets given pixels data as the button's mask directly, bypassing the texture or material readback.
+	 * Is useful for synthetic masks, e.g. in benchmarks, where no image is set in the Button Style. */
+	void SetRawColors(TArray<FColor>&& InRawColors, const FIntPoint& InSize);
+
+	/** Sets how pixels alpha is converted into the hit mask.
+	 * Is applied once when the mask is built, call ForceUpdateImage to rebuild already cached mask.
+	 * @param InAlphaThreshold Pixels with alpha above this value are hit-testable, -1 to use the default of the image type.
+	 * @param bInInvertAlpha If true, pixels with alpha at or below the threshold are hit-testable instead. */
+	void SetAlphaSettings(int32 InAlphaThreshold, bool bInInvertAlpha);
+
+	/** Returns the amount of memory in bytes allocated by the cached hit mask. */
+	SIZE_T GetHitMaskAllocatedSize() const { return HitMask.GetAllocatedSize(); }
+
 protected:
-	/** Cached buffer data about all pixels of current texture or material, is set once on render thread. */
-	TArray<FColor> RawColors;
+	/** Cached hit-test data about all pixels of current texture or material, one bit per pixel.
+	 * Is built once on game thread from read back Raw Colors, so alpha threshold, inversion and image type are already applied. */
+	TBitArray<> HitMask;
+
+	/** Pixels with alpha above this value are hit-testable, is applied when the hit mask is built.
+	 * If -1, any non-transparent pixel is hit-testable for textures and only fully opaque pixels for materials. */
+	int32 AlphaThreshold = INDEX_NONE;
+
+	/** If true, the hit mask is inverted: pixels with alpha at or below the threshold are hit-testable. */
+	bool bInvertAlpha = false;
+
+	/** Current loading state of the Raw Colors. */
+	ECustomShapeMaskState MaskState = ECustomShapeMaskState::None;
+
+	/** The frame number before which the failed mask is not queued again. */
+	uint64 MaskRetryFrame = 0;
 
 	/** Is created once if no render target was set before, cleanups on destruction. */
 	TStrongObjectPtr<UTextureRenderTarget2D> RenderTarget = nullptr;
@@ -51,6 +126,17 @@ protected:
 	/** Contains cached information about the mouse event. */
 	FPointerEvent CachedPointerEvent;
 
+	/** The frame number when the button was painted last time, is used to detect if the button is still on the screen. */
+	mutable uint64 LastPaintFrame = 0;
+
+	/** The clipping rect in desktop space the button was painted with last time, pointer outside of it can't hover the button. */
+	mutable FSlateRect LastCullingRect;
+
+	/** Is true if the button was painted as enabled last time, respects the parent's enabled state. */
+	mutable bool bLastPaintEnabled = false;
+
+	virtual int32 OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const override;
+
 	virtual FReply OnMouseButtonDown(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent) override;
 	virtual FReply OnMouseButtonDoubleClick(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent) override;
 	virtual FReply OnMouseButtonUp(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent) override;
@@ -60,15 +146,12 @@ protected:
 	virtual void OnMouseEnter(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent) override;
 	virtual FReply OnMouseEnter_Hovered(const FGeometry& MyGeometry, const FPointerEvent& MouseEvent);
 
-	/** Returns true if cursor is hovered on a texture or material.
+	/** Returns true if cursor is hovered on a hit-testable pixel of texture or material.
 	 * - Might be expensive to call frequently as it performs a full pixel check.
 	 * - It does not respect the overlap order returning true regardless of other widget layer.
 	 * Instead, prefer IsHovered(), which checks cached state and respects proper layering. */
 	virtual bool IsAlphaPixelHovered() const;
 
-	/** Set once on render thread the buffer data about all pixels of current image if was not set before. */
-	virtual void TryUpdateRawColorsOnce();
-
 	/** Copies the buffer data from the texture.
 	 * For public access call TryUpdateRawColorsOnce instead. */
 	virtual void UpdateRawColors_Texture(const class UTexture2D& Texture);
@@ -76,4 +159,25 @@ protected:
 	/** Copies the buffer data from the material.
 	 * For public access call TryUpdateRawColorsOnce instead. */
 	virtual void UpdateRawColors_Material(class UMaterialInterface& Material);
+
+	/** Reads the buffer data of given texture on render thread and applies it on game thread. */
+	void ReadRawColorsAsync(const class UTexture& Texture, bool bIsMaterial);
+
+	/** Returns the hit mask params from current alpha settings for given image type. */
+	FCustomShapeHitMaskParams MakeHitMaskParams(bool bIsMaterial) const;
+
+	/** Resets the mask state after failed readback, so the manager queues it again after a short delay. */
+	void RetryRawColorsUpdateLater();
+
+	/** Is called on game thread when the buffer data is read back, builds the hit mask from it.
+	 * If the data is empty or does not match the texture size, the readback is retried later. */
+	virtual void OnRawColorsUpdated(TArray<FColor>&& InRawColors, const FCustomShapeHitMaskParams& Params);
+
+private:
+	/** Only the manager queues masks, since it has to add the button to its pending list at the same time. */
+	friend class UCustomShapeButtonManager;
+
+	/** Marks the mask to be loaded by the manager's queue.
+	 * Returns true if the mask was not requested before and now is queued. */
+	bool TryQueueRawColorsUpdate();
 };
@@ -0,0 +1,21 @@
+﻿// Copyright (c) Yevhenii Selivanov.
+
+using UnrealBuildTool;
+
+public class CustomShapeButtonTests : ModuleRules
+{
+	public CustomShapeButtonTests(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+		CppStandard = CppStandardVersion.Latest;
+		bEnableNonInlinedGenCppWarnings = true;
+
+		PrivateDependencyModuleNames.AddRange(new[]
+			{
+				"Core", "CoreUObject", "Engine", "Slate", "SlateCore", "InputCore" // Core
+				, "UMG" // UCustomShapeButton base
+				, "CustomShapeButton" // Tested module
+			}
+		);
+	}
+}
@@ -0,0 +1,317 @@
+﻿// Copyright (c) Yevhenii Selivanov
+
+#include "CustomShapeButton.h"
+#include "CustomShapeButtonManager.h"
+#include "SCustomShapeButton.h"
+//---
+#include "InputCoreTypes.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Framework/Application/SlateApplication.h"
+#include "Input/HittestGrid.h"
+#include "Input/Reply.h"
+#include "Math/RandomStream.h"
+#include "Misc/App.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Rendering/DrawElements.h"
+#include "Widgets/SWindow.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Benchmarks hit-testing and event routing of Custom Shape Buttons at scale.
+ * Spawns given amount of buttons with synthetic circle masks and random Overlap Order, some of them are hidden, collapsed or not hit-testable.
+ * Then replays randomized or recorded pointer events through UCustomShapeButtonManager::HandleEvent in simulated frames,
+ * reports the per-frame cost of the manager tick and fails if the events throughput or latency is out of configured budgets.
+ * Runs only in game context (buttons are not registered in editor preview), works headless, e.g:
+ * UnrealEditor Project.uproject -game -nullrhi -unattended -ExecCmds="Automation RunTests CustomShapeButton.Benchmark; Quit"
+ */
+namespace CustomShapeButtonBenchmark
+{
+	static TAutoConsoleVariable<float> CVarMinEventsPerSecond(
+		TEXT("CustomShapeButton.Benchmark.MinEventsPerSecond"),
+		1000.f,
+		TEXT("The benchmark fails if fewer pointer events per second are routed through the manager."));
+
+	static TAutoConsoleVariable<float> CVarMaxP99Microseconds(
+		TEXT("CustomShapeButton.Benchmark.MaxP99Microseconds"),
+		5000.f,
+		TEXT("The benchmark fails if 99th percentile of a single event routing takes longer, in microseconds."));
+
+	static TAutoConsoleVariable<int32> CVarEventsPerFrame(
+		TEXT("CustomShapeButton.Benchmark.EventsPerFrame"),
+		4,
+		TEXT("How many pointer events are replayed per simulated frame, the manager rebuilds hit-testable buttons and ticks once per frame."));
+
+	static TAutoConsoleVariable<FString> CVarRecordedEventsFile(
+		TEXT("CustomShapeButton.Benchmark.RecordedEventsFile"),
+		TEXT(""),
+		TEXT("Optional file with recorded pointer positions to replay, each line is 'X Y' in screen space. Random events are used if empty, the test fails if the file gives no events."));
+
+	/** Virtual viewport where all the buttons are spread. */
+	static const FVector2D ViewportSize(1920.f, 1080.f);
+
+	/** Synthetic masks are generated in these resolutions to vary the memory and lookup cost. */
+	static const int32 MaskResolutions[] = {64, 128, 256};
+
+	/** Every N-th button is made non-interactive to exercise culling of the manager. */
+	static constexpr int32 NonInteractiveButtonsPeriod = 3;
+
+	/** Returns the synthetic mask of given resolution: opaque circle on transparent background. */
+	TArray<FColor> MakeCircleMask(int32 Resolution)
+	{
+		TArray<FColor> Mask;
+		Mask.SetNumZeroed(Resolution * Resolution);
+
+		const float Radius = Resolution * 0.5f;
+		for (int32 Y = 0; Y < Resolution; ++Y)
+		{
+			for (int32 X = 0; X < Resolution; ++X)
+			{
+				const FVector2f Delta(X + 0.5f - Radius, Y + 0.5f - Radius);
+				if (Delta.SizeSquared() <= FMath::Square(Radius))
+				{
+					Mask[Y * Resolution + X] = FColor::White;
+				}
+			}
+		}
+
+		return Mask;
+	}
+
+	/** Loads recorded pointer positions from given file, where each line is 'X Y' in screen space. */
+	TArray<FVector2D> LoadRecordedPositions(const FString& FilePath)
+	{
+		TArray<FString> Lines;
+		if (!FFileHelper::LoadFileToStringArray(Lines, *FilePath))
+		{
+			return {};
+		}
+
+		TArray<FVector2D> Positions;
+		Positions.Reserve(Lines.Num());
+		for (const FString& Line : Lines)
+		{
+			TArray<FString> Values;
+			Line.ParseIntoArrayWS(Values);
+			if (Values.Num() >= 2)
+			{
+				Positions.Emplace(FCString::Atof(*Values[0]), FCString::Atof(*Values[1]));
+			}
+		}
+
+		return Positions;
+	}
+
+	/** Returns the value of given percentile from sorted samples in microseconds. */
+	double GetPercentile(const TArray<uint64>& SortedCycles, double Percentile)
+	{
+		if (SortedCycles.IsEmpty())
+		{
+			return 0.0;
+		}
+
+		const int32 Index = FMath::Clamp(FMath::FloorToInt32(Percentile * (SortedCycles.Num() - 1)), 0, SortedCycles.Num() - 1);
+		return FPlatformTime::ToMilliseconds64(SortedCycles[Index]) * 1000.0;
+	}
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FCustomShapeButtonBenchmarkTest, "CustomShapeButton.Benchmark", EAutomationTestFlags::ClientContext | EAutomationTestFlags::PerfFilter)
+
+// Defines the benchmark variants as parameters: NumButtons NumEvents Seed
+void FCustomShapeButtonBenchmarkTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	OutBeautifiedNames.Add(TEXT("1000 Buttons"));
+	OutTestCommands.Add(TEXT("1000 20000 0"));
+
+	OutBeautifiedNames.Add(TEXT("5000 Buttons"));
+	OutTestCommands.Add(TEXT("5000 50000 0"));
+}
+
+// Runs the benchmark with given parameters and checks the results against budgets
+bool FCustomShapeButtonBenchmarkTest::RunTest(const FString& Parameters)
+{
+	using namespace CustomShapeButtonBenchmark;
+
+	TArray<FString> Args;
+	Parameters.ParseIntoArrayWS(Args);
+	const int32 NumButtons = Args.IsValidIndex(0) ? FMath::Max(1, FCString::Atoi(*Args[0])) : 1000;
+	const int32 NumEvents = Args.IsValidIndex(1) ? FMath::Max(1, FCString::Atoi(*Args[1])) : 20000;
+	const int32 Seed = Args.IsValidIndex(2) ? FCString::Atoi(*Args[2]) : 0;
+
+	UCustomShapeButtonManager* Manager = UCustomShapeButtonManager::GetCustomShapeButtonManager();
+	if (!TestTrue(TEXT("Engine and Slate application are initialized"), Manager && FSlateApplication::IsInitialized())
+		|| !TestTrue(TEXT("Buttons can be registered, run with -game"), UCustomShapeButtonManager::CanRegisterButton(nullptr)))
+	{
+		return false;
+	}
+
+	// Load recorded pointer events first, so nothing is spawned if they are not available
+	const FString RecordedEventsFile = CVarRecordedEventsFile.GetValueOnGameThread();
+	TArray<FVector2D> Positions;
+	if (!RecordedEventsFile.IsEmpty())
+	{
+		const FString RecordedEventsPath = FPaths::ConvertRelativePathToFull(RecordedEventsFile);
+		Positions = LoadRecordedPositions(RecordedEventsPath);
+		if (Positions.IsEmpty())
+		{
+			// Don't report a replay that never happened
+			AddError(FString::Printf(TEXT("No recorded events are loaded from '%s'"), *RecordedEventsPath));
+			return false;
+		}
+	}
+
+	FRandomStream Random(Seed);
+
+	TMap<int32, TArray<FColor>> MasksByResolution;
+	for (const int32 Resolution : MaskResolutions)
+	{
+		MasksByResolution.Add(Resolution, MakeCircleMask(Resolution));
+	}
+
+	// Spawn buttons with synthetic masks, it registers them in the manager
+	TArray<TStrongObjectPtr<UCustomShapeButton>> Buttons;
+	Buttons.Reserve(NumButtons);
+	const uint64 SpawnStartCycles = FPlatformTime::Cycles64();
+	for (int32 Index = 0; Index < NumButtons; ++Index)
+	{
+		UCustomShapeButton* Button = NewObject<UCustomShapeButton>(GetTransientPackage());
+		Button->OverlapOrder = Random.RandRange(-10, 10);
+		Buttons.Emplace(Button);
+
+		const TSharedRef<SWidget> Widget = Button->TakeWidget();
+		const int32 Resolution = MaskResolutions[Random.RandHelper(static_cast<int32>(UE_ARRAY_COUNT(MaskResolutions)))];
+		TArray<FColor> Mask = MasksByResolution.FindChecked(Resolution);
+		StaticCastSharedRef<SCustomShapeButton>(Widget)->SetRawColors(MoveTemp(Mask), FIntPoint(Resolution));
+	}
+	const double SpawnMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - SpawnStartCycles);
+
+	// Make some buttons non-interactive: collapsed and hidden ones are not painted as Slate does, hit-test invisible ones are
+	TArray<TSharedPtr<SCustomShapeButton>> NonInteractiveButtons;
+	for (int32 Index = 0; Index < Buttons.Num(); Index += NonInteractiveButtonsPeriod)
+	{
+		static const ESlateVisibility Visibilities[] = {ESlateVisibility::Collapsed, ESlateVisibility::Hidden, ESlateVisibility::HitTestInvisible};
+		Buttons[Index]->SetVisibility(Visibilities[Random.RandHelper(static_cast<int32>(UE_ARRAY_COUNT(Visibilities)))]);
+		NonInteractiveButtons.Add(Buttons[Index]->GetSlateCustomShapeButton());
+	}
+
+	// Paint each visible button once at random place to have its geometry cached for hit-testing
+	const TSharedRef<SWindow> Window = SNew(SWindow).ClientSize(ViewportSize);
+	FSlateWindowElementList ElementList(Window);
+	FHittestGrid HittestGrid;
+	HittestGrid.SetHittestArea(FVector2D::ZeroVector, ViewportSize);
+	const FPaintArgs PaintArgs(nullptr, HittestGrid, FVector2D::ZeroVector, FApp::GetCurrentTime(), FApp::GetDeltaTime());
+	const FSlateRect CullingRect(FVector2D::ZeroVector, ViewportSize);
+	for (const TStrongObjectPtr<UCustomShapeButton>& Button : Buttons)
+	{
+		const FVector2D Size(Random.FRandRange(32.f, 256.f));
+		const FVector2D Position(Random.FRandRange(0.f, ViewportSize.X - Size.X), Random.FRandRange(0.f, ViewportSize.Y - Size.Y));
+		const TSharedPtr<SCustomShapeButton> SButton = Button->GetSlateCustomShapeButton();
+		if (SButton->GetVisibility().IsVisible())
+		{
+			const FGeometry Geometry = FGeometry::MakeRoot(Size, FSlateLayoutTransform(Position));
+			SButton->Paint(PaintArgs, Geometry, CullingRect, ElementList, 0, FWidgetStyle(), /*bParentEnabled*/true);
+		}
+	}
+
+	SIZE_T MaskMemory = 0;
+	for (const TStrongObjectPtr<UCustomShapeButton>& Button : Buttons)
+	{
+		MaskMemory += Button->GetSlateCustomShapeButton()->GetHitMaskAllocatedSize();
+	}
+
+	// Prepare random pointer events stream if no recorded events are given
+	if (RecordedEventsFile.IsEmpty())
+	{
+		Positions.Reserve(NumEvents);
+		for (int32 Index = 0; Index < NumEvents; ++Index)
+		{
+			Positions.Emplace(Random.FRandRange(0.f, ViewportSize.X), Random.FRandRange(0.f, ViewportSize.Y));
+		}
+	}
+
+	// Replay events through the manager, non-interactive buttons must never become hovered
+	int32 NumHandled = 0;
+	int32 NumNonInteractiveHovered = 0;
+	uint64 TotalEventCycles = 0;
+	TArray<uint64> EventCycles;
+	EventCycles.Reserve(Positions.Num());
+	TArray<uint64> FrameCycles;
+	const int32 EventsPerFrame = FMath::Max(1, CVarEventsPerFrame.GetValueOnGameThread());
+	const auto Callback = [](const TSharedRef<SCustomShapeButton>&) { return FReply::Handled(); };
+	FVector2D LastPosition = Positions[0];
+	for (int32 EventIndex = 0; EventIndex < Positions.Num(); ++EventIndex)
+	{
+		if (EventIndex % EventsPerFrame == 0)
+		{
+			// Simulate new frame: the manager rebuilds hit-testable buttons and processes pending masks once per frame
+			Manager->MarkHitTestableButtonsDirty();
+			const uint64 FrameStartCycles = FPlatformTime::Cycles64();
+			Manager->Tick(FApp::GetDeltaTime());
+			FrameCycles.Add(FPlatformTime::Cycles64() - FrameStartCycles);
+		}
+
+		const FVector2D& Position = Positions[EventIndex];
+		const FPointerEvent Event(Position, LastPosition, TSet<FKey>(), EKeys::Invalid, 0.f, FModifierKeysState());
+		LastPosition = Position;
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		const FReply Reply = Manager->HandleEvent(Event, Callback);
+		const uint64 Cycles = FPlatformTime::Cycles64() - StartCycles;
+		EventCycles.Add(Cycles);
+		TotalEventCycles += Cycles;
+
+		NumHandled += Reply.IsEventHandled() ? 1 : 0;
+
+		// Is checked outside of measured time: any hover transition of culled button is caught, not only repeated hovers
+		for (const TSharedPtr<SCustomShapeButton>& SButton : NonInteractiveButtons)
+		{
+			NumNonInteractiveHovered += SButton->IsHovered() ? 1 : 0;
+		}
+	}
+	const double EventsSeconds = FPlatformTime::ToSeconds64(TotalEventCycles);
+	EventCycles.Sort();
+	FrameCycles.Sort();
+
+	// Measure registration churn: unregister and register again every button
+	const uint64 ChurnStartCycles = FPlatformTime::Cycles64();
+	for (const TStrongObjectPtr<UCustomShapeButton>& Button : Buttons)
+	{
+		Manager->UnregisterButton(Button.Get());
+		Manager->RegisterButton(Button.Get());
+	}
+
+	// Each registration change marks hit-testable buttons dirty, so include the rebuild that follows
+	Manager->Tick(FApp::GetDeltaTime());
+	const double ChurnMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - ChurnStartCycles);
+
+	// Cleanup, buttons will be garbage collected
+	for (const TStrongObjectPtr<UCustomShapeButton>& Button : Buttons)
+	{
+		Manager->UnregisterButton(Button.Get());
+	}
+
+	const double EventsPerSecond = EventsSeconds > 0.0 ? Positions.Num() / EventsSeconds : 0.0;
+	const double P99Microseconds = GetPercentile(EventCycles, 0.99);
+
+	AddInfo(FString::Printf(TEXT("Buttons: %i (non-interactive %i), Events: %i (handled %i), Seed: %i, Source: %s"),
+	                        NumButtons, NonInteractiveButtons.Num(), Positions.Num(), NumHandled, Seed, RecordedEventsFile.IsEmpty() ? TEXT("random") : *FString::Printf(TEXT("recorded '%s'"), *RecordedEventsFile)));
+	AddInfo(FString::Printf(TEXT("Events/sec: %.0f, p50: %.2f us, p99: %.2f us, max: %.2f us"),
+	                        EventsPerSecond, GetPercentile(EventCycles, 0.5), P99Microseconds, GetPercentile(EventCycles, 1.0)));
+	AddInfo(FString::Printf(TEXT("Frame update (rebuild and tick, %i events per frame): p50: %.2f us, p99: %.2f us, max: %.2f us"),
+	                        EventsPerFrame, GetPercentile(FrameCycles, 0.5), GetPercentile(FrameCycles, 0.99), GetPercentile(FrameCycles, 1.0)));
+	AddInfo(FString::Printf(TEXT("Mask memory: %.2f MB, Spawn: %.2f ms, Registration churn with rebuild: %.2f ms (%.2f us per button)"),
+	                        MaskMemory / (1024.0 * 1024.0), SpawnMs, ChurnMs, ChurnMs * 1000.0 / NumButtons));
+
+	TestEqual(TEXT("Events after which non-interactive buttons were hovered"), NumNonInteractiveHovered, 0);
+	TestTrue(FString::Printf(TEXT("Events/sec %.0f is within budget %.0f"), EventsPerSecond, CVarMinEventsPerSecond.GetValueOnGameThread()),
+	         EventsPerSecond >= CVarMinEventsPerSecond.GetValueOnGameThread());
+	TestTrue(FString::Printf(TEXT("p99 %.2f us is within budget %.2f us"), P99Microseconds, CVarMaxP99Microseconds.GetValueOnGameThread()),
+	         P99Microseconds <= CVarMaxP99Microseconds.GetValueOnGameThread());
+
+	return !HasAnyErrors();
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,5 @@
+﻿// Copyright (c) Yevhenii Selivanov.
+
+#include "Modules/ModuleManager.h"
+
+IMPLEMENT_MODULE(FDefaultModuleImpl, CustomShapeButtonTests)